@@ -0,0 +1,165 @@
+// Forward bytes through a loopback TCP proxy running as a fiber in an IOManager and report,
+// per forwarded byte, the bytes memcpy'd by Buffer and the bytes that crossed into or out of user space.
+//
+// Usage: Proxy_bench [megabytes]
+#include "IOManager.hpp"
+#include "SocketStream.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+using namespace myCoroutine;
+
+enum class Mode {
+    COPY, // Flatten every chunk to a std::string and back, what a proxy without Buffer would do
+    BUFFER, // SocketStream::read() into a Buffer and write() it out, readv()/writev() on the blocks
+    SPLICE // SocketStream::spliceTo(), socket to pipe to socket
+};
+
+static const size_t chunk = 64 * 1024; // The bytes forwarded per step
+
+// Connect a pair of loopback TCP sockets, fds[0] is the accepted end
+static void MakeTcpPair(int fds[2]) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family         = AF_INET;
+    addr.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+    socklen_t len           = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, len) || listen(listener, 1) ||
+        getsockname(listener, (struct sockaddr *)&addr, &len)) {
+        perror("listener");
+        exit(1);
+    }
+    fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fds[1], (struct sockaddr *)&addr, len)) {
+        perror("connect");
+        exit(1);
+    }
+    fds[0] = accept(listener, nullptr, nullptr);
+    close(listener);
+}
+
+struct Result {
+    double seconds;
+    uint64_t copied; // Bytes memcpy'd by Buffer
+    uint64_t crossed; // Bytes read into or written out of user memory by the proxy
+    bool ok;
+};
+
+static Result Run(Mode mode, size_t total) {
+    int in[2], out[2];
+    MakeTcpPair(in);
+    MakeTcpPair(out);
+    Result result = {0, 0, 0, true};
+    std::atomic<bool> done{false};
+
+    // The client writes a known pattern, the sink checks it
+    std::thread client([&] {
+        std::vector<char> buf(chunk);
+        size_t sent = 0;
+        while (sent < total) {
+            size_t n = std::min(chunk, total - sent);
+            for (size_t i = 0; i < n; i++) {
+                buf[i] = (char)((sent + i) % 251);
+            }
+            for (size_t off = 0; off < n;) {
+                ssize_t rt = write(in[1], buf.data() + off, n - off);
+                if (rt <= 0) {
+                    return;
+                }
+                off += rt;
+            }
+            sent += n;
+        }
+        close(in[1]);
+    });
+    std::thread sink([&] {
+        std::vector<char> buf(chunk);
+        size_t got = 0;
+        ssize_t rt;
+        while ((rt = read(out[1], buf.data(), buf.size())) > 0) {
+            for (ssize_t i = 0; i < rt; i++) {
+                if (buf[i] != (char)((got + i) % 251)) {
+                    result.ok = false;
+                }
+            }
+            got += rt;
+        }
+        result.ok = result.ok && got == total;
+        close(out[1]);
+    });
+
+    uint64_t copied = Buffer::BytesCopied();
+    auto start      = std::chrono::steady_clock::now();
+    {
+        IOManager iom(1, false, "Proxy_bench");
+        iom.start();
+        iom.schedule([&] {
+            SocketStream src(in[0]), dst(out[0]);
+            size_t forwarded = 0;
+            while (forwarded < total) {
+                ssize_t rt = 0;
+                if (mode == Mode::SPLICE) {
+                    rt = src.spliceTo(dst, total - forwarded);
+                } else {
+                    Buffer buf;
+                    rt = src.read(buf, chunk);
+                    if (rt <= 0) {
+                        break;
+                    }
+                    result.crossed += rt;
+                    if (mode == Mode::COPY) {
+                        std::string str = buf.toString();
+                        buf.clear();
+                        buf.append(str);
+                    }
+                    result.crossed += buf.size();
+                    rt = dst.write(buf);
+                }
+                if (rt <= 0) {
+                    break;
+                }
+                forwarded += rt;
+            }
+            dst.close();
+            done = true;
+        });
+        while (!done) {
+            usleep(1000);
+        }
+        iom.stop();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.copied  = Buffer::BytesCopied() - copied;
+    client.join();
+    sink.join();
+    return result;
+}
+
+int main(int argc, char **argv) {
+    size_t total = (argc > 1 ? atol(argv[1]) : 256) * 1024 * 1024;
+    const char *names[] = {"copy", "buffer", "splice"};
+    Mode modes[]        = {Mode::COPY, Mode::BUFFER, Mode::SPLICE};
+    std::vector<std::string> lines;
+    for (int i = 0; i < 3; i++) {
+        Result r = Run(modes[i], total);
+        char line[256];
+        snprintf(line, sizeof(line), "%-8s %10.1f %12.3f %12.3f %s", names[i], total / r.seconds / (1024 * 1024),
+                 (double)r.copied / total, (double)r.crossed / total, r.ok ? "ok" : "CORRUPT");
+        lines.push_back(line);
+    }
+    // The scheduler logs to stdout, print the table once everything is done
+    printf("forwarded %zu MB per mode\n", total / (1024 * 1024));
+    printf("%-8s %10s %12s %12s\n", "mode", "MB/s", "memcpy/B", "user-io/B");
+    for (auto &line : lines) {
+        printf("%s\n", line.c_str());
+    }
+    return 0;
+}
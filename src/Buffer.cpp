@@ -0,0 +1,327 @@
+#include "Buffer.hpp"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include <string.h>
+#include <sys/uio.h>
+namespace myCoroutine {
+static const size_t slab_blocks = 16; // The number of blocks carved out of one slab
+static const int max_iovecs = 16; // The most segments handed to one readv()/writev()
+
+static std::mutex s_block_mutex; // Protects the free list
+static std::vector<BufferBlock *> s_free_blocks; // The blocks not referenced by any buffer
+static std::atomic<uint64_t> s_block_count{0}; // The number of blocks ever carved
+static std::atomic<uint64_t> s_buffer_copied{0}; // The bytes memcpy'd in or out of buffers
+
+BufferBlock::ptr BufferBlock::Alloc() {
+    BufferBlock *block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s_block_mutex);
+        if (s_free_blocks.empty()) {
+            // Slabs are never given back to the system, their blocks are recycled through the free list
+            BufferBlock *slab = new BufferBlock[slab_blocks];
+            for (size_t i = 0; i < slab_blocks; i++) {
+                s_free_blocks.push_back(&slab[i]);
+            }
+            s_block_count += slab_blocks;
+        }
+        block = s_free_blocks.back();
+        s_free_blocks.pop_back();
+    }
+    block->m_used = 0;
+    block->m_refs = 1;
+    return BufferBlock::ptr(block);
+}
+
+void BufferBlock::Release(BufferBlock *block) {
+    std::lock_guard<std::mutex> lock(s_block_mutex);
+    s_free_blocks.push_back(block);
+}
+
+uint64_t BufferBlock::TotalBlocks() {
+    return s_block_count;
+}
+
+uint64_t BufferBlock::FreeBlocks() {
+    std::lock_guard<std::mutex> lock(s_block_mutex);
+    return s_free_blocks.size();
+}
+
+
+void Buffer::push(BufferBlock::ptr block, size_t offset, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    m_size += length;
+    if (!m_segments.empty()) {
+        Segment &last = m_segments.back();
+        if (last.block == block && last.offset + last.length == offset) { // Merge with the adjacent segment
+            last.length += length;
+            return;
+        }
+    }
+    m_segments.push_back(Segment{block, offset, length});
+}
+
+size_t Buffer::reserveTail(size_t len) {
+    if (len == 0 || m_segments.empty()) {
+        return 0;
+    }
+    Segment &last = m_segments.back();
+    size_t end = last.offset + last.length;
+    size_t n   = std::min(len, last.block->capacity() - end);
+    if (n == 0 || !last.block->m_used.compare_exchange_strong(end, end + n)) {
+        return 0;
+    }
+    return n;
+}
+
+void Buffer::clear() {
+    m_segments.clear();
+    m_size = 0;
+}
+
+void Buffer::append(const void *data, size_t len) {
+    const char *src = (const char *)data;
+    s_buffer_copied += len;
+    size_t n = reserveTail(len); // Fill the free space of the last block first
+    if (n > 0) {
+        Segment &last = m_segments.back();
+        memcpy(last.data() + last.length, src, n);
+        last.length += n;
+        m_size += n;
+        src += n;
+        len -= n;
+    }
+    while (len > 0) {
+        BufferBlock::ptr block = BufferBlock::Alloc();
+        n = std::min(len, block->capacity());
+        memcpy(block->data(), src, n);
+        block->m_used = n;
+        push(block, 0, n);
+        src += n;
+        len -= n;
+    }
+}
+
+void Buffer::append(const Buffer &other) {
+    if (&other == this) {
+        Buffer copy(other);
+        append(std::move(copy));
+        return;
+    }
+    for (auto &seg : other.m_segments) {
+        push(seg.block, seg.offset, seg.length);
+    }
+}
+
+void Buffer::append(Buffer &&other) {
+    if (&other == this) {
+        return;
+    }
+    if (!m_segments.empty() && !other.m_segments.empty()) { // The boundary segments may be adjacent
+        Segment &first = other.m_segments.front();
+        push(first.block, first.offset, first.length);
+        other.m_size -= first.length;
+        other.m_segments.pop_front();
+    }
+    m_segments.splice(m_segments.end(), other.m_segments);
+    m_size += other.m_size;
+    other.m_size = 0;
+}
+
+Buffer Buffer::split(size_t len) {
+    Buffer rt;
+    len = std::min(len, m_size);
+    m_size -= len;
+    while (len > 0) {
+        Segment &seg = m_segments.front();
+        if (seg.length <= len) {
+            len -= seg.length;
+            rt.push(seg.block, seg.offset, seg.length);
+            m_segments.pop_front();
+        } else {
+            rt.push(seg.block, seg.offset, len);
+            seg.offset += len;
+            seg.length -= len;
+            len = 0;
+        }
+    }
+    return rt;
+}
+
+Buffer Buffer::slice(size_t offset, size_t len) const {
+    Buffer rt;
+    if (offset >= m_size) {
+        return rt;
+    }
+    len = std::min(len, m_size - offset);
+    for (auto it = m_segments.begin(); it != m_segments.end() && len > 0; ++it) {
+        if (offset >= it->length) {
+            offset -= it->length;
+            continue;
+        }
+        size_t n = std::min(len, it->length - offset);
+        rt.push(it->block, it->offset + offset, n);
+        offset = 0;
+        len -= n;
+    }
+    return rt;
+}
+
+void Buffer::consume(size_t len) {
+    len = std::min(len, m_size);
+    m_size -= len;
+    while (len > 0) {
+        Segment &seg = m_segments.front();
+        if (seg.length <= len) {
+            len -= seg.length;
+            m_segments.pop_front();
+        } else {
+            seg.offset += len;
+            seg.length -= len;
+            len = 0;
+        }
+    }
+}
+
+size_t Buffer::copyOut(void *dst, size_t len, size_t offset) const {
+    char *out = (char *)dst;
+    size_t copied = 0;
+    for (auto it = m_segments.begin(); it != m_segments.end() && copied < len; ++it) {
+        if (offset >= it->length) {
+            offset -= it->length;
+            continue;
+        }
+        size_t n = std::min(len - copied, it->length - offset);
+        memcpy(out + copied, it->data() + offset, n);
+        offset = 0;
+        copied += n;
+    }
+    s_buffer_copied += copied;
+    return copied;
+}
+
+std::string Buffer::toString() const {
+    std::string str(m_size, '\0');
+    copyOut(&str[0], m_size);
+    return str;
+}
+
+ssize_t Buffer::find(const std::string &delim, size_t start) const {
+    if (delim.empty() || start + delim.size() > m_size) {
+        return -1;
+    }
+    size_t pos = 0;
+    for (auto it = m_segments.begin(); it != m_segments.end(); ++it) {
+        if (pos + it->length <= start) {
+            pos += it->length;
+            continue;
+        }
+        size_t i = start > pos ? start - pos : 0;
+        for (; i < it->length; i++) {
+            if (pos + i + delim.size() > m_size) {
+                return -1;
+            }
+            if (it->data()[i] != delim[0]) {
+                continue;
+            }
+            // Compare the rest of delim, which may run into the following segments
+            auto cur    = it;
+            size_t idx  = i + 1;
+            size_t k    = 1;
+            while (k < delim.size()) {
+                if (idx == cur->length) {
+                    ++cur;
+                    idx = 0;
+                }
+                if (cur->data()[idx] != delim[k]) {
+                    break;
+                }
+                ++idx;
+                ++k;
+            }
+            if (k == delim.size()) {
+                return pos + i;
+            }
+        }
+        pos += it->length;
+    }
+    return -1;
+}
+
+ssize_t Buffer::readFrom(int fd, size_t len) {
+    struct iovec iovs[max_iovecs];
+    BufferBlock::ptr blocks[max_iovecs];
+    int cnt      = 0;
+    size_t total = reserveTail(len); // Read into the free space of the last block first
+    bool in_tail = total > 0;
+    if (in_tail) {
+        Segment &last = m_segments.back();
+        iovs[0].iov_base = last.data() + last.length;
+        iovs[0].iov_len  = total;
+        cnt = 1;
+    }
+    while (total < len && cnt < max_iovecs) {
+        blocks[cnt] = BufferBlock::Alloc();
+        size_t n = std::min(len - total, blocks[cnt]->capacity());
+        iovs[cnt].iov_base = blocks[cnt]->data();
+        iovs[cnt].iov_len  = n;
+        total += n;
+        ++cnt;
+    }
+    if (cnt == 0) {
+        return 0;
+    }
+    ssize_t rt = readv(fd, iovs, cnt);
+    if (in_tail) { // Give back the reserved bytes that were not filled
+        Segment &last = m_segments.back();
+        size_t end    = last.offset + last.length + iovs[0].iov_len;
+        size_t filled = rt > 0 ? std::min((size_t)rt, iovs[0].iov_len) : 0;
+        last.block->m_used.compare_exchange_strong(end, end - iovs[0].iov_len + filled);
+    }
+    if (rt <= 0) {
+        return rt;
+    }
+    // Commit the filled part of every iovec, the untouched blocks go back to the free list
+    size_t left = rt;
+    for (int i = 0; i < cnt && left > 0; i++) {
+        size_t n = std::min(left, iovs[i].iov_len);
+        if (i == 0 && in_tail) {
+            Segment &last = m_segments.back();
+            last.length += n;
+            m_size += n;
+        } else {
+            blocks[i]->m_used = n;
+            push(blocks[i], 0, n);
+        }
+        left -= n;
+    }
+    return rt;
+}
+
+ssize_t Buffer::writeTo(int fd, size_t len) {
+    struct iovec iovs[max_iovecs];
+    int cnt = 0;
+    len = std::min(len, m_size);
+    for (auto it = m_segments.begin(); it != m_segments.end() && cnt < max_iovecs && len > 0; ++it) {
+        size_t n = std::min(len, it->length);
+        iovs[cnt].iov_base = it->data();
+        iovs[cnt].iov_len  = n;
+        len -= n;
+        ++cnt;
+    }
+    if (cnt == 0) {
+        return 0;
+    }
+    ssize_t rt = writev(fd, iovs, cnt);
+    if (rt > 0) {
+        consume(rt);
+    }
+    return rt;
+}
+
+uint64_t Buffer::BytesCopied() {
+    return s_buffer_copied;
+}
+} // namespace myCoroutine
@@ -0,0 +1,111 @@
+#ifndef MYCOROUTINE_BUFFER_HPP
+#define MYCOROUTINE_BUFFER_HPP
+#include "Noncopyable.hpp"
+#include <memory>
+#include <list>
+#include <string>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <sys/types.h>
+namespace myCoroutine {
+static const size_t default_blocksize = 16 * 1024; // The size of one block of a buffer is 16KB
+
+// A fixed-size chunk of memory carved out of a slab, shared by every buffer that references it
+class BufferBlock : Noncopyable {
+public:
+    // A counted reference to a block. The count lives in the block, so taking one never allocates.
+    class ptr {
+    public:
+        ptr() = default;
+        ptr(const ptr &other)
+            : m_block(other.m_block) {
+            if (m_block) {
+                m_block->m_refs.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        ptr(ptr &&other) noexcept
+            : m_block(other.m_block) {
+            other.m_block = nullptr;
+        }
+        ~ptr() { reset(); }
+        ptr &operator=(ptr other) noexcept {
+            std::swap(m_block, other.m_block);
+            return *this;
+        }
+        void reset() {
+            // The last reference puts the block back, the acquire side sees every write made through the others
+            if (m_block && m_block->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Release(m_block);
+            }
+            m_block = nullptr;
+        }
+        BufferBlock *get() const { return m_block; }
+        BufferBlock *operator->() const { return m_block; }
+        explicit operator bool() const { return m_block != nullptr; }
+        bool operator==(const ptr &other) const { return m_block == other.m_block; }
+    private:
+        friend class BufferBlock;
+        explicit ptr(BufferBlock *block)
+            : m_block(block) {} // Adopts the reference Alloc() counted
+    private:
+        BufferBlock *m_block = nullptr;
+    };
+    static BufferBlock::ptr Alloc(); // Take a block from the free list, carving a new slab if it is empty
+    static uint64_t TotalBlocks();
+    static uint64_t FreeBlocks();
+    char *data() { return m_data; }
+    size_t capacity() const { return default_blocksize; }
+    size_t used() const { return m_used.load(); }
+private:
+    BufferBlock() = default;
+    static void Release(BufferBlock *block); // Put the block back on the free list once the last reference is gone
+    friend class Buffer;
+private:
+    std::atomic<uint32_t> m_refs{0}; // The references held by ptr
+    std::atomic<size_t> m_used{0}; // The bytes already handed out, new data is only written after this mark
+    char m_data[default_blocksize]; // The payload of the block
+};
+
+// A chain of (block, offset, length) segments. Appending another buffer, splitting
+// and slicing only move references to blocks around, the bytes themselves are never copied.
+// A buffer is not thread-safe, but blocks may be shared between buffers on different threads.
+class Buffer {
+public:
+    typedef std::shared_ptr<Buffer> ptr;
+    Buffer() = default;
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t segmentCount() const { return m_segments.size(); }
+    void clear();
+    void append(const void *data, size_t len); // Copy the bytes in, reusing the free space of the last block
+    void append(const std::string &str) { append(str.data(), str.size()); }
+    void append(const Buffer &other); // Share the segments of other
+    void append(Buffer &&other); // Take over the segments of other
+    Buffer split(size_t len); // Cut the first len bytes off into a new buffer
+    Buffer slice(size_t offset, size_t len) const; // A view of [offset, offset + len) sharing the same blocks
+    void consume(size_t len); // Drop the first len bytes
+    size_t copyOut(void *dst, size_t len, size_t offset = 0) const;
+    std::string toString() const;
+    ssize_t find(const std::string &delim, size_t start = 0) const; // Return the position of delim, or -1
+    ssize_t readFrom(int fd, size_t len); // readv() up to len bytes directly into the blocks
+    ssize_t writeTo(int fd, size_t len = SIZE_MAX); // writev() up to len bytes directly from the blocks and consume them
+    static uint64_t BytesCopied(); // The total bytes memcpy'd in or out of any buffer
+private:
+    struct Segment {
+        BufferBlock::ptr block;
+        size_t offset;
+        size_t length;
+
+        char *data() const { return block->data() + offset; }
+    };
+    void push(BufferBlock::ptr block, size_t offset, size_t length);
+    // Claim at most len bytes after the last segment, 0 unless it ends at the mark of its block.
+    // The mark is moved with a compare-and-swap, so buffers sharing the block never claim the same bytes.
+    size_t reserveTail(size_t len);
+private:
+    std::list<Segment> m_segments; // The segments of the buffer in order
+    size_t m_size = 0; // The total bytes of all the segments
+};
+} // namespace myCoroutine
+#endif // MYCOROUTINE_BUFFER_HPP
@@ -14,7 +14,7 @@ static std::atomic<uint64_t> s_fiber_count{0};
 static const size_t default_stacksize = 128 * 1024; // The default size of the stack is 128KB
 
 
-class Fiber : std::enable_shared_from_this<Fiber> {
+class Fiber : public std::enable_shared_from_this<Fiber> {
 public:
     typedef std::shared_ptr<Fiber> ptr;
     enum class State { // Define the state of the coroutine
@@ -32,6 +32,7 @@ public:
     void yield();
     uint64_t getId() const { return m_id; }
     State getState() const { return m_state; }
+    bool isRunInScheduler() const { return m_runInScheduler; }
     static void SetThis(Fiber *f);
     static Fiber::ptr GetThis();
     static uint64_t TotalFibers();
@@ -44,7 +45,7 @@ private:
     ucontext_t m_ctx; // The context of the coroutine
     void *m_stack = nullptr; // The stack of the coroutine
     std::function<void()> m_cb; // The callback function of the coroutine
-    bool m_runInScheduler; // Whether the coroutine runs in the scheduler
+    bool m_runInScheduler = false; // Whether the coroutine runs in the scheduler
 };
 // Define the thread_local variables
 static thread_local Fiber *t_fiber = nullptr; // The coroutine of the current thread
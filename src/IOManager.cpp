@@ -0,0 +1,197 @@
+#include "IOManager.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+namespace myCoroutine {
+static const int max_events    = 64; // The most events taken by one epoll_wait()
+static const int epoll_timeout = 1000; // The longest an idle thread sleeps before checking stopping() again, in ms
+
+IOManager::IOManager(size_t threads, bool use_caller, const std::string &name)
+    : Scheduler(threads, use_caller, name) {
+    m_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epfd == -1) {
+        throw std::runtime_error("epoll_create error");
+    }
+    if (pipe2(m_tickleFds, O_NONBLOCK | O_CLOEXEC)) {
+        close(m_epfd);
+        throw std::runtime_error("pipe error");
+    }
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = nullptr; // The only registration without a fd context
+    if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_tickleFds[0], &ev)) {
+        close(m_tickleFds[0]);
+        close(m_tickleFds[1]);
+        close(m_epfd);
+        throw std::runtime_error("epoll_ctl error");
+    }
+}
+
+IOManager::~IOManager() {
+    stop();
+    for (FdContext *ctx : m_fdContexts) {
+        delete ctx;
+    }
+    close(m_epfd);
+    close(m_tickleFds[0]);
+    close(m_tickleFds[1]);
+}
+
+IOManager *IOManager::GetThis() {
+    return dynamic_cast<IOManager *>(Scheduler::GetThis());
+}
+
+IOManager::FdContext *IOManager::getFdContext(int fd) {
+    std::lock_guard<std::mutex> lock(m_fdMutex);
+    if ((size_t)fd >= m_fdContexts.size()) {
+        m_fdContexts.resize(std::max((size_t)fd + 1, m_fdContexts.size() * 3 / 2), nullptr);
+    }
+    if (!m_fdContexts[fd]) {
+        m_fdContexts[fd]     = new FdContext;
+        m_fdContexts[fd]->fd = fd;
+    }
+    return m_fdContexts[fd];
+}
+
+bool IOManager::updateEvents(FdContext *ctx) {
+    uint32_t events = (ctx->read ? (uint32_t)EPOLLIN : 0) | (ctx->write ? (uint32_t)EPOLLOUT : 0);
+    if (events == ctx->events) {
+        return true;
+    }
+    struct epoll_event ev;
+    ev.events   = events;
+    ev.data.ptr = ctx;
+    int rt;
+    if (!events) {
+        rt = epoll_ctl(m_epfd, EPOLL_CTL_DEL, ctx->fd, nullptr);
+    } else if (!ctx->events) {
+        rt = epoll_ctl(m_epfd, EPOLL_CTL_ADD, ctx->fd, &ev);
+    } else {
+        rt = epoll_ctl(m_epfd, EPOLL_CTL_MOD, ctx->fd, &ev);
+        if (rt && errno == ENOENT) { // Closed without cancelEvents(), epoll dropped it
+            rt = epoll_ctl(m_epfd, EPOLL_CTL_ADD, ctx->fd, &ev);
+        }
+    }
+    if (rt && events) {
+        return false;
+    }
+    ctx->events = events; // A failed delete means the fd is already gone from epoll
+    return true;
+}
+
+void IOManager::wake(Waiter *&waiter, int error) {
+    Waiter *w = waiter;
+    waiter    = nullptr;
+    w->error  = error;
+    // The waiter is gone as soon as the fiber runs again, so take the fiber out first
+    // and only stop counting it once it is queued
+    Fiber::ptr fiber = std::move(w->fiber);
+    schedule(fiber);
+    --m_pendingEventCount;
+}
+
+bool IOManager::waitEvent(int fd, uint32_t event) {
+    if (fd < 0 || (event != EPOLLIN && event != EPOLLOUT)) {
+        errno = EINVAL;
+        return false;
+    }
+    FdContext *ctx = getFdContext(fd);
+    Waiter waiter;
+    // Register only after the fiber has yielded, otherwise the event may resume it on another thread halfway through the swap
+    YieldThen([this, ctx, &waiter, event](Fiber::ptr fiber) {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        Waiter *&slot = event == EPOLLIN ? ctx->read : ctx->write;
+        if (slot) {
+            waiter.error = EBUSY;
+            schedule(fiber);
+            return;
+        }
+        slot = &waiter;
+        if (!updateEvents(ctx)) {
+            slot         = nullptr;
+            waiter.error = errno;
+            schedule(fiber);
+            return;
+        }
+        waiter.fiber = fiber;
+        ++m_pendingEventCount;
+    });
+    // The callback ran on whichever thread the fiber left, report its error from here
+    if (waiter.error) {
+        errno = waiter.error;
+        return false;
+    }
+    return true;
+}
+
+void IOManager::cancelEvents(int fd) {
+    FdContext *ctx = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_fdMutex);
+        if (fd >= 0 && (size_t)fd < m_fdContexts.size()) {
+            ctx = m_fdContexts[fd];
+        }
+    }
+    if (!ctx) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    if (ctx->read) {
+        wake(ctx->read, ECANCELED);
+    }
+    if (ctx->write) {
+        wake(ctx->write, ECANCELED);
+    }
+    updateEvents(ctx);
+}
+
+void IOManager::tickle() {
+    // Written even when no thread looks idle, one about to enter epoll_wait() picks it up instead of sleeping
+    if (write(m_tickleFds[1], "T", 1) != 1 && errno != EAGAIN) { // A full pipe will wake them up anyway
+        std::cout << "IOManager::tickle() write error" << std::endl;
+    }
+}
+
+bool IOManager::stopping() {
+    // A fiber registers while its thread still counts as active and is queued before it stops counting as pending,
+    // so reading the count on both sides of Scheduler::stopping() never misses one in flight
+    return m_pendingEventCount == 0 && Scheduler::stopping() && m_pendingEventCount == 0;
+}
+
+void IOManager::idle() {
+    struct epoll_event events[max_events];
+    while (!stopping()) {
+        int rt = epoll_wait(m_epfd, events, max_events, epoll_timeout);
+        if (rt < 0 && errno != EINTR) {
+            std::cout << "IOManager::idle() epoll_wait error" << std::endl;
+        }
+        for (int i = 0; i < rt; i++) {
+            FdContext *ctx = (FdContext *)events[i].data.ptr;
+            if (!ctx) { // Tickled
+                char buf[64];
+                while (read(m_tickleFds[0], buf, sizeof(buf)) > 0) {
+                }
+                continue;
+            }
+            // Another thread may have served the fd since this event was collected, only wake who is still waiting
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            uint32_t happened = events[i].events;
+            if (happened & (EPOLLERR | EPOLLHUP)) { // Both sides find out from their next call
+                happened |= EPOLLIN | EPOLLOUT;
+            }
+            if ((happened & EPOLLIN) && ctx->read) {
+                wake(ctx->read, 0);
+            }
+            if ((happened & EPOLLOUT) && ctx->write) {
+                wake(ctx->write, 0);
+            }
+            updateEvents(ctx);
+        }
+        Fiber::GetThis()->yield();
+    }
+    // A tickle wakes only one of the threads sleeping in epoll_wait(), pass the stop on to the next one
+    tickle();
+}
+} // namespace myCoroutine
@@ -0,0 +1,56 @@
+#ifndef MYCOROUTINE_IOMANAGER_HPP
+#define MYCOROUTINE_IOMANAGER_HPP
+#include "Scheduler.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <sys/epoll.h>
+namespace myCoroutine {
+// A scheduler whose idle threads sleep in epoll_wait() and resume the fibers waiting for fd readiness
+class IOManager : public Scheduler {
+public:
+    typedef std::shared_ptr<IOManager> ptr;
+
+    IOManager(size_t threads = 1, bool use_caller = true, const std::string &name = "IOManager");
+    ~IOManager();
+    // Park the current fiber until fd is ready for event (EPOLLIN or EPOLLOUT), false with errno set if it
+    // cannot be watched or the wait is cancelled. Errors and hangups also wake the fiber.
+    // One fiber may wait for each direction of a fd at a time, EBUSY for a second one.
+    bool waitEvent(int fd, uint32_t event);
+    // Wake the fibers waiting on fd with ECANCELED and stop watching it. Call it before closing fd,
+    // epoll forgets a closed fd and its waiters would never be woken.
+    void cancelEvents(int fd);
+    static IOManager *GetThis();
+protected:
+    void tickle() override;
+    void idle() override;
+    bool stopping() override;
+private:
+    // A fiber parked on one direction of a fd, lives on its stack
+    struct Waiter {
+        Fiber::ptr fiber;
+        int error = 0; // The errno waitEvent() fails with, 0 if the fd became ready
+    };
+    // The waiters of a fd, registered with epoll for the events they wait for together
+    struct FdContext {
+        std::mutex mutex;
+        int fd = -1;
+        uint32_t events = 0; // The events registered with epoll, 0 if the fd is not registered
+        Waiter *read = nullptr; // Waiting for EPOLLIN
+        Waiter *write = nullptr; // Waiting for EPOLLOUT
+    };
+private:
+    FdContext *getFdContext(int fd);
+    void wake(Waiter *&waiter, int error); // Queue the fiber of a waiter and clear its slot, the context must be locked
+    bool updateEvents(FdContext *ctx); // Register the events the waiters of ctx need with epoll, the context must be locked
+private:
+    int m_epfd = -1; // The epoll instance
+    int m_tickleFds[2] = {-1, -1}; // A pipe written to wake up the idle threads
+    std::atomic<size_t> m_pendingEventCount = {0}; // The fibers waiting for an event
+    std::mutex m_fdMutex; // Guards m_fdContexts
+    std::vector<FdContext *> m_fdContexts; // Indexed by fd, created on first wait and kept until destruction
+};
+} // namespace myCoroutine
+#endif // MYCOROUTINE_IOMANAGER_HPP
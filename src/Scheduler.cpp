@@ -15,6 +15,7 @@
 namespace myCoroutine {
 static thread_local Scheduler *t_scheduler = nullptr; // Current scheduler
 static thread_local Fiber *t_scheduler_fiber = nullptr; // The main coroutine of the scheduler
+static thread_local std::function<void(Fiber::ptr)> t_yield_cb; // Left by YieldThen() for run() to call once the fiber is off its stack
 
 Scheduler::Scheduler(size_t threads, bool use_caller, const std::string &name) {
     assert(threads > 0);
@@ -77,7 +78,8 @@ void Scheduler::start() {
 
 bool Scheduler::stopping() {
     std::lock_guard<MutexType> lock(m_mutex);
-    return m_stopping && m_tasks.empty() && m_activeThreadCount == 0;
+    return m_stopping && m_tasks.empty() && m_activeThreadCount == 0 && m_awayFiberCount == 0 &&
+           m_incomingFiberCount == 0;
 }
 
 void Scheduler::tickle() { 
@@ -96,7 +98,10 @@ void Scheduler::stop() {
     if (stopping()) {
         return;
     }
-    m_stopping = true;
+    {
+        std::lock_guard<MutexType> lock(m_mutex);
+        m_stopping = true;
+    }
 
     /// 如果use caller，那只能由caller线程发起stop
     if (m_useCaller) {
@@ -129,6 +134,53 @@ void Scheduler::stop() {
     }
 }
 
+void Scheduler::switchTo(int thread) {
+    if (GetThis() == this && (thread == -1 || thread == myCoroutine::GetThreadId())) {
+        return; // Already there, no need to leave the thread
+    }
+    {
+        // Checked and counted in one go, so stop() cannot slip in between and let the threads exit before the fiber lands
+        std::lock_guard<MutexType> lock(m_mutex);
+        if (m_stopping) {
+            throw std::logic_error("switchTo a stopping scheduler");
+        }
+        ++m_incomingFiberCount;
+    }
+    try {
+        YieldThen([this, thread](Fiber::ptr fiber) {
+            schedule(fiber, thread);
+            --m_incomingFiberCount;
+        });
+    } catch (...) {
+        --m_incomingFiberCount;
+        throw;
+    }
+}
+
+void Scheduler::YieldThen(std::function<void(Fiber::ptr)> cb) {
+    Fiber::ptr cur = Fiber::GetThis();
+    if (!GetThis() || !cur->isRunInScheduler() || cur.get() == GetMainFiber()) {
+        throw std::logic_error("YieldThen must be called from a scheduled fiber");
+    }
+    // The fiber can only be handed to anyone after its context is saved, otherwise another
+    // thread may resume it halfway through the swap. Leave the callback for run() instead.
+    t_yield_cb = std::move(cb);
+    auto raw_ptr = cur.get();
+    cur.reset();
+    raw_ptr->yield();
+}
+
+void Scheduler::Handoff(Fiber::ptr fiber) {
+    if (!t_yield_cb) {
+        return;
+    }
+    std::function<void(Fiber::ptr)> cb;
+    cb.swap(t_yield_cb);
+    if (fiber->getState() != Fiber::State::DEAD) {
+        cb(fiber);
+    }
+}
+
 void Scheduler::run() {
     std::cout << "run" << std::endl;
     //set_hook_enable(true);
@@ -169,6 +221,7 @@ void Scheduler::run() {
         }
         if (task.fiber) {
             task.fiber->resume();
+            Handoff(task.fiber); // Requeue before the thread stops counting as active, or stopping() may see no work
             --m_activeThreadCount;
             task.reset();
         } else if (task.cb) {
@@ -179,6 +232,7 @@ void Scheduler::run() {
             }
             task.reset();
             cb_fiber->resume();
+            Handoff(cb_fiber);
             --m_activeThreadCount;
             cb_fiber.reset();
         } else {
@@ -193,4 +247,47 @@ void Scheduler::run() {
     }
     std::cout << "Scheduler::run() end" << std::endl;
 }
+
+SchedulerSwitcher::SchedulerSwitcher(Scheduler *target, bool pin_thread)
+    : m_caller(Scheduler::GetThis()) {
+    if (!target) {
+        return;
+    }
+    if (!m_caller) {
+        throw std::logic_error("SchedulerSwitcher must be used from a scheduled fiber");
+    }
+    if (target == m_caller) {
+        return;
+    }
+    if (pin_thread) {
+        m_thread = myCoroutine::GetThreadId();
+    }
+    // Counted before the fiber leaves, while its thread still counts as active on m_caller
+    ++m_caller->m_awayFiberCount;
+    m_moved = true;
+    try {
+        target->switchTo();
+    } catch (...) {
+        --m_caller->m_awayFiberCount;
+        m_moved = false;
+        throw;
+    }
+}
+
+SchedulerSwitcher::~SchedulerSwitcher() {
+    if (!m_moved) {
+        return;
+    }
+    if (Scheduler::GetThis() == m_caller && (m_thread == -1 || myCoroutine::GetThreadId() == m_thread)) {
+        --m_caller->m_awayFiberCount; // Already back
+        return;
+    }
+    // Queue the fiber before it stops counting as away, so m_caller never looks idle meanwhile
+    Scheduler *caller = m_caller;
+    int thread        = m_thread;
+    Scheduler::YieldThen([caller, thread](Fiber::ptr fiber) {
+        caller->schedule(fiber, thread);
+        --caller->m_awayFiberCount;
+    });
+}
 }
\ No newline at end of file
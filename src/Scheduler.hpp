@@ -13,6 +13,7 @@
 #include <thread>
 namespace myCoroutine {
 class Scheduler {
+    friend class SchedulerSwitcher;
 public:
     typedef std::shared_ptr<Scheduler> ptr;
     typedef std::mutex MutexType;
@@ -36,6 +37,12 @@ public:
     }
     void start();
     void stop();
+    // Move the current fiber to this scheduler, pinned to thread if it is not -1.
+    // Returns at once if the fiber is already running where it should, throws logic_error once stop() has been called.
+    // The move is one-way, SchedulerSwitcher also keeps the original scheduler from stopping until the fiber is back.
+    void switchTo(int thread = -1);
+    // Yield the current fiber and call cb with it on the scheduler's thread once its context is saved
+    static void YieldThen(std::function<void(Fiber::ptr)> cb);
 protected:
     virtual void tickle();
     void run();
@@ -44,6 +51,7 @@ protected:
     void setThis();
     bool hasIdleThreads() { return m_idleThreadCount > 0; }
 private:
+    static void Handoff(Fiber::ptr fiber); // Call the callback left by YieldThen(), if any
 
     template <class FiberOrCb>
     bool scheduleNoLock(FiberOrCb fc, int thread) {
@@ -105,6 +113,23 @@ private:
     int m_rootThread = 0;
 
     bool m_stopping = false;
+
+    std::atomic<size_t> m_awayFiberCount = {0}; // Fibers moved away by a SchedulerSwitcher that have not returned yet
+
+    std::atomic<size_t> m_incomingFiberCount = {0}; // Fibers accepted by switchTo() that are not queued yet
+};
+
+// Switch the current fiber to a scheduler for the lifetime of the object and back to the caller's scheduler
+// afterwards. The way back is a yield and an enqueue like the way out, and is skipped if the fiber is already home.
+// It lands on any thread of the caller unless pin_thread is set, then it waits for the thread it came from.
+class SchedulerSwitcher : public Noncopyable {
+public:
+    SchedulerSwitcher(Scheduler *target = nullptr, bool pin_thread = false);
+    ~SchedulerSwitcher();
+private:
+    Scheduler *m_caller; // The scheduler the fiber returns to
+    int m_thread = -1; // The thread the fiber returns to, -1 for any
+    bool m_moved = false; // Whether m_caller is counting the fiber as away
 };
 }
 #endif
\ No newline at end of file
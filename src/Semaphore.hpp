@@ -18,23 +18,23 @@ public:
 private:
     sem_t m_semaphore; // The semaphore
 };
-Semaphore::Semaphore(uint32_t count) {
+inline Semaphore::Semaphore(uint32_t count) {
     if(sem_init(&m_semaphore, 0, count)) {
         throw std::logic_error("sem_init error");
     }
 }
 
-Semaphore::~Semaphore() {
+inline Semaphore::~Semaphore() {
     sem_destroy(&m_semaphore);
 }
 
-void Semaphore::wait() {
+inline void Semaphore::wait() {
     if(sem_wait(&m_semaphore)) {
         throw std::logic_error("sem_wait error");
     }
 }
 
-void Semaphore::notify() {
+inline void Semaphore::notify() {
     if(sem_post(&m_semaphore)) {
         throw std::logic_error("sem_post error");
     }
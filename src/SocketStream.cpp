@@ -0,0 +1,253 @@
+#include "SocketStream.hpp"
+#include "Fiber.hpp"
+#include "IOManager.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+namespace myCoroutine {
+static const size_t read_chunk   = 64 * 1024; // The bytes asked from the socket by one read
+static const size_t splice_chunk = 64 * 1024; // The default capacity of a pipe
+
+SocketStream::SocketStream(int fd, bool owner)
+    : m_fd(fd)
+    , m_owner(owner) {
+    int flags = fcntl(m_fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        if (m_owner) {
+            ::close(m_fd);
+        }
+        throw std::runtime_error("fcntl O_NONBLOCK error");
+    }
+}
+
+SocketStream::~SocketStream() {
+    if (m_owner) {
+        close();
+    }
+    closePipe();
+}
+
+void SocketStream::close() {
+    if (m_fd != -1) {
+        if (m_parked > 0) { // Epoll forgets a closed socket, wake the fibers waiting on it first
+            m_iom.load()->cancelEvents(m_fd);
+        }
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    closePipe();
+}
+
+void SocketStream::closePipe() {
+    if (m_pipe[0] != -1) {
+        ::close(m_pipe[0]);
+        ::close(m_pipe[1]);
+        m_pipe[0] = m_pipe[1] = -1;
+        m_pipeSize = 0;
+    }
+}
+
+bool SocketStream::park(short events) {
+    IOManager *iom = IOManager::GetThis();
+    if (iom && Fiber::GetThis()->isRunInScheduler()) {
+        // Sleep until epoll reports the socket ready, the thread runs other fibers meanwhile
+        m_iom = iom;
+        ++m_parked;
+        bool rt = iom->waitEvent(m_fd, (events & POLLIN) ? (uint32_t)EPOLLIN : (uint32_t)EPOLLOUT);
+        --m_parked;
+        return rt;
+    }
+    // Anywhere else, fibers of a plain Scheduler included, the thread blocks
+    struct pollfd pfd;
+    pfd.fd      = m_fd;
+    pfd.events  = events;
+    pfd.revents = 0;
+    int rt;
+    do {
+        rt = poll(&pfd, 1, -1);
+    } while (rt < 0 && errno == EINTR);
+    return rt > 0;
+}
+
+ssize_t SocketStream::fill(size_t len) {
+    while (true) {
+        ssize_t rt = m_readBuf.readFrom(m_fd, len);
+        if (rt >= 0) {
+            return rt;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || !park(POLLIN)) {
+            return -1;
+        }
+    }
+}
+
+ssize_t SocketStream::read(Buffer &out, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (m_readBuf.empty()) {
+        ssize_t rt = fill(std::max(len, read_chunk));
+        if (rt <= 0) {
+            return rt;
+        }
+    }
+    size_t n = std::min(len, m_readBuf.size());
+    out.append(m_readBuf.split(n));
+    return n;
+}
+
+ssize_t SocketStream::readExactly(Buffer &out, size_t len) {
+    while (m_readBuf.size() < len) {
+        ssize_t rt = fill(std::max(len - m_readBuf.size(), read_chunk));
+        if (rt <= 0) {
+            return rt;
+        }
+    }
+    out.append(m_readBuf.split(len));
+    return len;
+}
+
+ssize_t SocketStream::readUntil(Buffer &out, const std::string &delim, size_t max_len) {
+    if (delim.empty()) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t start = 0;
+    while (true) {
+        ssize_t pos = m_readBuf.find(delim, start);
+        if (pos >= 0) {
+            size_t n = pos + delim.size();
+            if (n > max_len) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+            out.append(m_readBuf.split(n));
+            return n;
+        }
+        if (m_readBuf.size() >= max_len) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        // Only the tail that may hold the beginning of delim has to be searched again
+        start = m_readBuf.size() >= delim.size() ? m_readBuf.size() - delim.size() + 1 : 0;
+        ssize_t rt = fill(read_chunk);
+        if (rt <= 0) {
+            return rt;
+        }
+    }
+}
+
+ssize_t SocketStream::write(Buffer &in) {
+    size_t total = 0;
+    while (!in.empty()) {
+        ssize_t rt = in.writeTo(m_fd);
+        if (rt >= 0) {
+            total += rt;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || !park(POLLOUT)) {
+            return total ? total : -1;
+        }
+    }
+    return total;
+}
+
+ssize_t SocketStream::sendfile(int in_fd, off_t *offset, size_t count) {
+    size_t total = 0;
+    while (total < count) {
+        ssize_t rt = ::sendfile(m_fd, in_fd, offset, count - total);
+        if (rt > 0) {
+            total += rt;
+            continue;
+        }
+        if (rt == 0) { // The end of the file
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || !park(POLLOUT)) {
+            return total ? total : -1;
+        }
+    }
+    return total;
+}
+
+bool SocketStream::drainPipe(SocketStream &dst, size_t len, size_t &total) {
+    while (len > 0) {
+        ssize_t n = splice(m_pipe[0], nullptr, dst.m_fd, nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            len -= n;
+            m_pipeSize -= n;
+            total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || !dst.park(POLLOUT)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ssize_t SocketStream::spliceTo(SocketStream &dst, size_t count) {
+    size_t total = 0;
+    // Whatever a failed call left in the pipe came off the socket before the read buffer was filled again
+    if (m_pipeSize > 0 && !drainPipe(dst, std::min(count, m_pipeSize), total)) {
+        return total ? total : -1;
+    }
+    if (total < count && !m_readBuf.empty()) { // The bytes received ahead go out next to keep the order
+        Buffer head = m_readBuf.split(count - total);
+        size_t len = head.size();
+        dst.write(head);
+        total += len - head.size();
+        if (!head.empty()) { // Put back what dst did not take
+            head.append(std::move(m_readBuf));
+            m_readBuf = std::move(head);
+            return total ? total : -1;
+        }
+    }
+    if (total == count) {
+        return total;
+    }
+    if (m_pipe[0] == -1 && pipe2(m_pipe, O_NONBLOCK | O_CLOEXEC)) {
+        m_pipe[0] = m_pipe[1] = -1;
+        return total ? total : -1;
+    }
+    while (total < count) {
+        // Move the bytes from the socket into the pipe, they never reach user space
+        ssize_t rt = splice(m_fd, nullptr, m_pipe[1], nullptr, std::min(count - total, splice_chunk),
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (rt == 0) { // EOF
+            break;
+        }
+        if (rt < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) || !park(POLLIN)) {
+                return total ? total : -1;
+            }
+            continue;
+        }
+        // Drain the pipe into dst before reading any more
+        m_pipeSize += rt;
+        if (!drainPipe(dst, m_pipeSize, total)) {
+            return total ? total : -1;
+        }
+    }
+    return total;
+}
+} // namespace myCoroutine
@@ -0,0 +1,49 @@
+#ifndef MYCOROUTINE_SOCKETSTREAM_HPP
+#define MYCOROUTINE_SOCKETSTREAM_HPP
+#include "Buffer.hpp"
+#include "Noncopyable.hpp"
+#include <memory>
+#include <atomic>
+#include <string>
+#include <sys/types.h>
+namespace myCoroutine {
+class IOManager;
+
+// A non-blocking socket read and written through buffers. When the socket is not ready,
+// a fiber running in an IOManager is parked until epoll reports it ready instead of blocking
+// its thread; any other caller blocks in poll(). A reader and a writer fiber may use the stream at the
+// same time, and close() wakes them both.
+// All the calls return the bytes transferred, 0 on EOF, or -1 with errno set. The writes return how far they
+// got if an error stops them after some bytes went out, and set errno to it.
+class SocketStream : Noncopyable {
+public:
+    typedef std::shared_ptr<SocketStream> ptr;
+    SocketStream(int fd, bool owner = true); // Switch fd to non-blocking, close it on destruction if owner
+    ~SocketStream();
+    int getFd() const { return m_fd; }
+    Buffer &getReadBuffer() { return m_readBuf; } // The bytes received but not handed out yet
+    ssize_t read(Buffer &out, size_t len); // Read at most len bytes, waiting only if none are buffered
+    ssize_t readExactly(Buffer &out, size_t len); // Read len bytes, 0 if EOF comes first and the rest stays buffered
+    ssize_t readUntil(Buffer &out, const std::string &delim, size_t max_len = SIZE_MAX); // Read up to and including delim
+    ssize_t write(Buffer &in); // Write all of in, consuming what went out
+    ssize_t sendfile(int in_fd, off_t *offset, size_t count); // Send count bytes of a file without copying them to user space
+    // Forward at most count bytes to dst through a pipe, fewer on EOF. Returns the bytes forwarded, or -1 if an
+    // error came before any. Bytes taken off the socket that dst did not accept stay in the pipe and go out first next time.
+    ssize_t spliceTo(SocketStream &dst, size_t count);
+    void close();
+private:
+    ssize_t fill(size_t len); // Receive at most len more bytes into the read buffer
+    bool drainPipe(SocketStream &dst, size_t len, size_t &total); // Splice len bytes out of the pipe into dst
+    void closePipe();
+    bool park(short events); // Wait until the socket is ready for events (POLLIN or POLLOUT), false on error
+private:
+    int m_fd = -1; // The socket
+    bool m_owner = true; // Whether the socket is closed with the stream
+    Buffer m_readBuf; // Bytes received ahead of what the caller asked for
+    int m_pipe[2] = {-1, -1}; // The pipe of spliceTo(), created on first use
+    size_t m_pipeSize = 0; // Bytes sitting in the pipe
+    std::atomic<IOManager *> m_iom = {nullptr}; // The IOManager fibers last parked in on the socket
+    std::atomic<int> m_parked = {0}; // Fibers parked on the socket, close() wakes them
+};
+} // namespace myCoroutine
+#endif // MYCOROUTINE_SOCKETSTREAM_HPP
@@ -0,0 +1,188 @@
+#include "Buffer.hpp"
+#include <cassert>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+using namespace myCoroutine;
+
+static std::atomic<uint64_t> s_allocs{0}; // Heap allocations made by the test
+
+void *operator new(size_t size) {
+    ++s_allocs;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// A buffer of len bytes 'a', 'b', 'c', ... spanning several blocks
+static Buffer MakeBuffer(size_t len) {
+    std::string str(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        str[i] = 'a' + i % 26;
+    }
+    Buffer buf;
+    buf.append(str);
+    return buf;
+}
+
+static void test_block_refs() {
+    BufferBlock::Alloc(); // Make sure a slab has been carved
+    uint64_t free_blocks = BufferBlock::FreeBlocks();
+    uint64_t allocs      = s_allocs;
+    {
+        BufferBlock::ptr a = BufferBlock::Alloc();
+        BufferBlock::ptr b = a;
+        BufferBlock::ptr c = std::move(b);
+        assert(!b && c == a);
+        a.reset();
+        assert(BufferBlock::FreeBlocks() == free_blocks - 1); // c still holds it
+    }
+    assert(BufferBlock::FreeBlocks() == free_blocks);
+    assert(s_allocs == allocs); // Taking and dropping references never touches the heap
+}
+
+static void test_append() {
+    Buffer buf = MakeBuffer(default_blocksize * 2 + 10);
+    assert(buf.size() == default_blocksize * 2 + 10);
+    assert(buf.segmentCount() == 3);
+    buf.append("xyz", 3); // Fills the free space of the last block
+    assert(buf.segmentCount() == 3);
+    assert(buf.toString().substr(buf.size() - 3) == "xyz");
+
+    Buffer other = MakeBuffer(5);
+    uint64_t copied = Buffer::BytesCopied();
+    buf.append(other);
+    assert(Buffer::BytesCopied() == copied); // Sharing the blocks copies nothing
+    assert(buf.size() == default_blocksize * 2 + 18);
+    assert(other.size() == 5);
+    buf.append(std::move(other));
+    assert(other.empty());
+    assert(buf.toString().substr(buf.size() - 10) == "abcdeabcde");
+}
+
+static void test_split() {
+    Buffer buf = MakeBuffer(default_blocksize * 2);
+    std::string all = buf.toString();
+    Buffer head = buf.split(default_blocksize - 1); // Cut one byte short of the block boundary
+    assert(head.size() == default_blocksize - 1 && head.segmentCount() == 1);
+    assert(buf.size() == default_blocksize + 1 && buf.segmentCount() == 2);
+    Buffer mid = buf.split(2); // Straddles the boundary
+    assert(mid.segmentCount() == 2);
+    assert(mid.toString() == all.substr(default_blocksize - 1, 2));
+    assert(buf.toString() == all.substr(default_blocksize + 1));
+    Buffer rest = buf.split(SIZE_MAX);
+    assert(buf.empty() && buf.segmentCount() == 0);
+    assert(rest.size() == default_blocksize - 1);
+}
+
+static void test_slice() {
+    Buffer buf = MakeBuffer(default_blocksize * 3);
+    std::string all = buf.toString();
+    Buffer s = buf.slice(default_blocksize - 2, default_blocksize + 4); // Touches all three blocks
+    assert(s.segmentCount() == 3);
+    assert(s.toString() == all.substr(default_blocksize - 2, default_blocksize + 4));
+    assert(buf.size() == default_blocksize * 3); // The source is untouched
+    assert(buf.slice(buf.size(), 1).empty());
+    assert(buf.slice(buf.size() - 2, 100).toString() == all.substr(all.size() - 2));
+
+    // A slice shares the tail block, so only one of them may grow into it
+    Buffer part = MakeBuffer(10);
+    Buffer tail = part.slice(0, part.size());
+    part.append("1", 1);
+    tail.append("2", 1);
+    assert(part.segmentCount() == 1 && tail.segmentCount() == 2);
+    assert(part.toString() == "abcdefghij1");
+    assert(tail.toString() == "abcdefghij2");
+}
+
+static void test_find() {
+    Buffer buf;
+    buf.append(std::string(default_blocksize - 1, 'x') + "\r\nend");
+    assert(buf.segmentCount() == 2);
+    assert(buf.find("\r\n") == (ssize_t)default_blocksize - 1); // The delimiter straddles the boundary
+    assert(buf.find("\r\nend") == (ssize_t)default_blocksize - 1);
+    assert(buf.find("x", default_blocksize - 2) == (ssize_t)default_blocksize - 2);
+    assert(buf.find("x", default_blocksize - 1) == -1);
+    assert(buf.find("endx") == -1);
+    assert(buf.find("") == -1);
+    Buffer empty;
+    assert(empty.find("a") == -1);
+}
+
+static void test_consume() {
+    Buffer buf = MakeBuffer(default_blocksize + 5);
+    buf.consume(default_blocksize + 1);
+    assert(buf.size() == 4 && buf.segmentCount() == 1);
+    assert(buf.toString() == MakeBuffer(default_blocksize + 5).toString().substr(default_blocksize + 1));
+    buf.consume(100);
+    assert(buf.empty());
+}
+
+static void test_fd() {
+    int fds[2];
+    int rt = pipe(fds);
+    assert(rt == 0);
+    Buffer out = MakeBuffer(default_blocksize + 100);
+    std::string expect = out.toString();
+    uint64_t copied = Buffer::BytesCopied();
+    ssize_t wrote = out.writeTo(fds[1]);
+    assert(wrote == (ssize_t)expect.size());
+    assert(out.empty());
+    Buffer in;
+    size_t total = 0;
+    while (total < expect.size()) {
+        ssize_t rt = in.readFrom(fds[0], expect.size() - total);
+        assert(rt > 0);
+        total += rt;
+    }
+    assert(Buffer::BytesCopied() == copied); // readv()/writev() go straight to the blocks
+    assert(in.toString() == expect);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void test_shared_tail_threads() {
+    // Two buffers sharing a tail block append on different threads and must not write over each other
+    for (int round = 0; round < 100; round++) {
+        Buffer a = MakeBuffer(10);
+        Buffer b = a;
+        std::thread t([&b] {
+            for (int i = 0; i < 1000; i++) {
+                b.append("b", 1);
+            }
+        });
+        for (int i = 0; i < 1000; i++) {
+            a.append("a", 1);
+        }
+        t.join();
+        assert(a.toString() == MakeBuffer(10).toString() + std::string(1000, 'a'));
+        assert(b.toString() == MakeBuffer(10).toString() + std::string(1000, 'b'));
+    }
+}
+
+int main() {
+    test_block_refs();
+    test_append();
+    test_split();
+    test_slice();
+    test_find();
+    test_consume();
+    test_fd();
+    test_shared_tail_threads();
+    std::cout << "Buffer_test passed" << std::endl;
+    return 0;
+}
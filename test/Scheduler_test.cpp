@@ -0,0 +1,147 @@
+#include "IOManager.hpp"
+#include "Func.hpp"
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+using namespace myCoroutine;
+
+static const int fiber_count = 20;
+
+// Fibers hop from an I/O scheduler to a CPU one and back while the I/O scheduler is being stopped.
+// With pin_thread they come back to the thread they left, otherwise to any thread of the I/O scheduler.
+static void test_switch_round_trip(bool pin_thread) {
+    std::atomic<int> done{0};
+    IOManager io(2, false, "io");
+    IOManager cpu(2, false, "cpu");
+    io.start();
+    cpu.start();
+    for (int i = 0; i < fiber_count; i++) {
+        io.schedule([&] {
+            assert(Scheduler::GetThis() == &io);
+            pid_t origin = GetThreadId();
+            io.switchTo(); // Already there, returns at once
+            assert(GetThreadId() == origin);
+            {
+                SchedulerSwitcher switcher(&cpu, pin_thread);
+                assert(Scheduler::GetThis() == &cpu);
+                assert(GetThreadId() != origin);
+                volatile long sum = 0;
+                for (long k = 0; k < 100000; k++) {
+                    sum = sum + k;
+                }
+            }
+            assert(Scheduler::GetThis() == &io);
+            assert(!pin_thread || GetThreadId() == origin);
+            ++done;
+        });
+    }
+    io.stop(); // Must wait for the fibers still away on cpu
+    assert(done == fiber_count);
+    cpu.stop();
+}
+
+// Outside any scheduler there is nowhere to come back to
+static void test_switch_without_caller() {
+    IOManager cpu(1, false, "cpu");
+    cpu.start();
+    bool thrown = false;
+    try {
+        SchedulerSwitcher switcher(&cpu);
+    } catch (std::logic_error &) {
+        thrown = true;
+    }
+    assert(thrown);
+    SchedulerSwitcher nothing; // No target, nothing to do
+    cpu.stop();
+}
+
+// A one-way move leaves the fiber on the target
+static void test_switch_one_way() {
+    std::atomic<bool> done{false};
+    IOManager io(1, false, "io");
+    IOManager cpu(1, false, "cpu");
+    io.start();
+    cpu.start();
+    io.schedule([&] {
+        cpu.switchTo();
+        assert(Scheduler::GetThis() == &cpu);
+        done = true;
+    });
+    while (!done) {
+        usleep(1000);
+    }
+    io.stop();
+    cpu.stop();
+}
+
+// Fibers switching to a scheduler while it is being stopped either land there and run, or get the exception
+static void test_switch_while_stopping() {
+    for (int round = 0; round < 20; round++) {
+        std::atomic<int> arrived{0}, rejected{0};
+        IOManager io(2, false, "io");
+        IOManager cpu(2, false, "cpu");
+        io.start();
+        cpu.start();
+        for (int i = 0; i < fiber_count; i++) {
+            io.schedule([&] {
+                try {
+                    cpu.switchTo();
+                    ++arrived;
+                } catch (std::logic_error &) {
+                    ++rejected;
+                }
+            });
+        }
+        cpu.stop();
+        io.stop();
+        assert(arrived + rejected == fiber_count);
+    }
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Neither a stop nor a fiber handed over may wait for the epoll_wait() timeout of a sleeping thread
+static void test_idle_wakeup() {
+    IOManager io(4, false, "io");
+    IOManager cpu(4, false, "cpu");
+    io.start();
+    cpu.start();
+    usleep(50 * 1000); // Let all the threads go to sleep
+    std::atomic<bool> done{false};
+    auto start = std::chrono::steady_clock::now();
+    io.schedule([&] {
+        for (int i = 0; i < 10; i++) {
+            SchedulerSwitcher switcher(&cpu);
+        }
+        done = true;
+    });
+    while (!done) {
+        usleep(1000);
+    }
+    double round_trips = SecondsSince(start);
+    // Stop while one thread is still busy, the others go back to sleep and must be woken once it is done
+    io.schedule([] { usleep(100 * 1000); });
+    cpu.schedule([] { usleep(100 * 1000); });
+    usleep(10 * 1000);
+    start = std::chrono::steady_clock::now();
+    io.stop();
+    cpu.stop();
+    double stops = SecondsSince(start);
+    assert(round_trips < 0.5);
+    assert(stops < 0.5);
+}
+
+int main() {
+    test_switch_round_trip(false);
+    test_switch_round_trip(true);
+    test_switch_without_caller();
+    test_switch_one_way();
+    test_switch_while_stopping();
+    test_idle_wakeup();
+    std::cout << "Scheduler_test passed" << std::endl;
+    return 0;
+}
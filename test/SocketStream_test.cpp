@@ -0,0 +1,368 @@
+#include "SocketStream.hpp"
+#include "IOManager.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+using namespace myCoroutine;
+
+static void MakePair(int fds[2]) {
+    int rt = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(rt == 0);
+}
+
+// Write str to fd and close it, so the reader sees EOF right after
+static void SendAndClose(int fd, const std::string &str) {
+    ssize_t rt = write(fd, str.data(), str.size());
+    assert(rt == (ssize_t)str.size());
+    close(fd);
+}
+
+// len bytes of a pattern that shows reordering and loss
+static std::string Pattern(size_t len) {
+    std::string str(len, '\0');
+    for (size_t i = 0; i < len; i++) {
+        str[i] = (char)(i % 251);
+    }
+    return str;
+}
+
+// Read fd until EOF, pausing between reads if slow so the writer backs up
+static std::string ReadAll(int fd, bool slow = false) {
+    std::string str;
+    char buf[16 * 1024];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        str.append(buf, n);
+        if (slow) {
+            usleep(1000);
+        }
+    }
+    return str;
+}
+
+static void test_read_until() {
+    int fds[2];
+    MakePair(fds);
+    SocketStream stream(fds[0]);
+    SendAndClose(fds[1], "GET / HTTP/1.1\r\nHost: x\r\n\r\ntail");
+    Buffer line;
+    ssize_t rt = stream.readUntil(line, "\r\n");
+    assert(rt == 16);
+    assert(line.toString() == "GET / HTTP/1.1\r\n");
+    Buffer headers;
+    rt = stream.readUntil(headers, "\r\n\r\n");
+    assert(rt == 11);
+    assert(headers.toString() == "Host: x\r\n\r\n");
+    // EOF before the delimiter returns 0 and leaves the bytes buffered
+    Buffer rest;
+    rt = stream.readUntil(rest, "\r\n");
+    assert(rt == 0);
+    assert(rest.empty());
+    assert(stream.getReadBuffer().toString() == "tail");
+}
+
+static void test_read_until_limit() {
+    int fds[2];
+    MakePair(fds);
+    SocketStream stream(fds[0]);
+    SendAndClose(fds[1], "0123456789\n");
+    Buffer out;
+    ssize_t rt = stream.readUntil(out, "\n", 5);
+    assert(rt == -1 && errno == EMSGSIZE);
+    assert(out.empty());
+    rt = stream.readUntil(out, "\n");
+    assert(rt == 11);
+}
+
+static void test_read_exactly() {
+    int fds[2];
+    MakePair(fds);
+    SocketStream stream(fds[0]);
+    std::string payload(default_blocksize * 2 + 3, 'p');
+    SendAndClose(fds[1], payload + "xyz");
+    Buffer out;
+    ssize_t rt = stream.readExactly(out, payload.size());
+    assert(rt == (ssize_t)payload.size());
+    assert(out.toString() == payload);
+    // EOF before len bytes returns 0 and leaves the bytes buffered
+    Buffer rest;
+    rt = stream.readExactly(rest, 10);
+    assert(rt == 0);
+    assert(rest.empty());
+    assert(stream.getReadBuffer().toString() == "xyz");
+    Buffer last;
+    rt = stream.read(last, 10);
+    assert(rt == 3);
+    rt = stream.read(last, 10);
+    assert(rt == 0);
+}
+
+static void test_splice() {
+    int in[2], out[2];
+    MakePair(in);
+    MakePair(out);
+    SocketStream src(in[0]), dst(out[0]);
+    SendAndClose(in[1], "line\r\nbody-bytes");
+    Buffer line;
+    ssize_t rt = src.readUntil(line, "\r\n");
+    assert(rt == 6);
+    // The read-ahead goes out before the spliced bytes
+    rt = src.spliceTo(dst, 100);
+    assert(rt == 10);
+    rt = src.spliceTo(dst, 100);
+    assert(rt == 0);
+    char buf[32];
+    rt = read(out[1], buf, sizeof(buf));
+    assert(rt == 10);
+    assert(std::string(buf, 10) == "body-bytes");
+    close(out[1]);
+}
+
+// The bytes reach src in pieces after spliceTo() has started waiting for them
+static void test_splice_late_data() {
+    int in[2], out[2];
+    MakePair(in);
+    MakePair(out);
+    std::string expect = Pattern(3 * 1000);
+    std::atomic<ssize_t> rt{0};
+    {
+        SocketStream src(in[0]), dst(out[0]);
+        IOManager iom(1, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            ssize_t total = 0, n;
+            while ((n = src.spliceTo(dst, 1 << 20)) > 0) {
+                total += n;
+            }
+            rt = n < 0 ? n : total;
+        });
+        for (int i = 0; i < 3; i++) {
+            usleep(20 * 1000); // The fiber is parked on the empty socket by now
+            ssize_t n = ::write(in[1], expect.data() + i * 1000, 1000);
+            assert(n == 1000);
+        }
+        close(in[1]);
+        iom.stop();
+    }
+    assert(rt == (ssize_t)expect.size());
+    std::string got = ReadAll(out[1]);
+    assert(got == expect);
+    close(out[1]);
+}
+
+// dst takes the bytes slower than src delivers them, so the splice keeps parking on dst
+static void test_splice_backpressure() {
+    int in[2], out[2];
+    MakePair(in);
+    MakePair(out);
+    int sndbuf = 4096;
+    setsockopt(out[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    std::string expect = Pattern(1024 * 1024);
+    std::thread client([&] {
+        for (size_t off = 0; off < expect.size();) {
+            ssize_t n = ::write(in[1], expect.data() + off, expect.size() - off);
+            assert(n > 0);
+            off += n;
+        }
+        close(in[1]);
+    });
+    std::string got;
+    std::thread sink([&] {
+        got = ReadAll(out[1], true);
+        close(out[1]);
+    });
+    std::atomic<ssize_t> rt{0};
+    {
+        SocketStream src(in[0]), dst(out[0]);
+        IOManager iom(2, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            rt = src.spliceTo(dst, expect.size());
+            dst.close();
+        });
+        iom.stop();
+    }
+    client.join();
+    sink.join();
+    assert(rt == (ssize_t)expect.size());
+    assert(got == expect);
+}
+
+// sendfile() from a file larger than the socket buffer, the fiber parks until the reader drains it
+static void test_sendfile() {
+    char path[] = "/tmp/SocketStream_test_XXXXXX";
+    int file = mkstemp(path);
+    assert(file >= 0);
+    unlink(path);
+    std::string expect = Pattern(1024 * 1024 + 17);
+    ssize_t n = ::write(file, expect.data(), expect.size());
+    assert(n == (ssize_t)expect.size());
+    int fds[2];
+    MakePair(fds);
+    std::string got;
+    std::thread sink([&] {
+        got = ReadAll(fds[1]);
+        close(fds[1]);
+    });
+    off_t offset = 10;
+    std::atomic<ssize_t> rt{0}, rest{-1};
+    {
+        SocketStream stream(fds[0]);
+        IOManager iom(1, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            rt   = stream.sendfile(file, &offset, expect.size());
+            rest = stream.sendfile(file, &offset, 100); // Already at the end of the file
+            stream.close();
+        });
+        iom.stop();
+    }
+    sink.join();
+    close(file);
+    assert(rt == (ssize_t)expect.size() - 10); // Stops short at the end of the file
+    assert(rest == 0);
+    assert(offset == (off_t)expect.size());
+    assert(got == expect.substr(10));
+}
+
+static void test_park_in_iomanager() {
+    int fds[2];
+    MakePair(fds);
+    std::atomic<int> done{0};
+    {
+        IOManager iom(2, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            SocketStream stream(fds[0]);
+            Buffer out;
+            if (stream.readUntil(out, "\n") == 6 && out.toString() == "hello\n") {
+                ++done;
+            }
+            if (stream.readExactly(out, 4) == 0) { // EOF
+                ++done;
+            }
+        });
+        usleep(100 * 1000); // Let the fiber park on the empty socket
+        SendAndClose(fds[1], "hello\nab");
+        iom.stop();
+    }
+    assert(done == 2);
+}
+
+// An error after some bytes went out reports them, and leaves the rest in the buffer
+static void test_write_partial() {
+    int fds[2];
+    MakePair(fds);
+    const size_t total = 4 * 1024 * 1024;
+    std::thread peer([&] { // Take some, then hang up
+        char buf[64 * 1024];
+        size_t got = 0;
+        while (got < 100000) {
+            ssize_t n = ::read(fds[1], buf, sizeof(buf));
+            assert(n > 0);
+            got += n;
+        }
+        close(fds[1]);
+    });
+    SocketStream stream(fds[0]);
+    Buffer in;
+    in.append(std::string(total, 'w'));
+    ssize_t rt = stream.write(in);
+    int err    = errno;
+    peer.join();
+    assert(rt >= 100000 && rt < (ssize_t)total);
+    assert(err == EPIPE);
+    assert(in.size() == total - rt);
+}
+
+// A reader and a writer fiber parked on the same socket at once, the peer echoes everything back
+static void test_full_duplex() {
+    int fds[2];
+    MakePair(fds);
+    const size_t total = 4 * 1024 * 1024; // Far more than the socket buffers hold, so the writer parks too
+    std::thread echo([&] {
+        char buf[64 * 1024];
+        ssize_t n;
+        while ((n = ::read(fds[1], buf, sizeof(buf))) > 0) {
+            for (ssize_t off = 0; off < n;) {
+                ssize_t rt = ::write(fds[1], buf + off, n - off);
+                assert(rt > 0);
+                off += rt;
+            }
+        }
+        close(fds[1]);
+    });
+    std::atomic<ssize_t> wrote{0}, got{0};
+    std::string expect;
+    for (size_t i = 0; i < total; i++) {
+        expect.push_back('a' + i % 26);
+    }
+    std::string received;
+    {
+        SocketStream stream(fds[0]);
+        IOManager iom(2, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            Buffer out;
+            got = stream.readExactly(out, total);
+            received = out.toString();
+        });
+        iom.schedule([&] {
+            Buffer in;
+            in.append(expect);
+            wrote = stream.write(in);
+        });
+        iom.stop();
+    }
+    echo.join();
+    assert(wrote == (ssize_t)total);
+    assert(got == (ssize_t)total);
+    assert(received == expect);
+}
+
+// close() wakes a fiber parked on the socket, so the IOManager can stop
+static void test_close_wakes_parked() {
+    int fds[2];
+    MakePair(fds);
+    SocketStream stream(fds[0]);
+    std::atomic<ssize_t> rt{1};
+    std::atomic<int> err{0};
+    {
+        IOManager iom(1, false, "SocketStream_test");
+        iom.start();
+        iom.schedule([&] {
+            Buffer out;
+            rt  = stream.read(out, 10);
+            err = errno;
+        });
+        usleep(100 * 1000); // Let the fiber park on the empty socket
+        stream.close();
+        iom.stop();
+    }
+    assert(rt == -1 && err == ECANCELED);
+    close(fds[1]);
+}
+
+int main() {
+    signal(SIGPIPE, SIG_IGN);
+    test_read_until();
+    test_read_until_limit();
+    test_read_exactly();
+    test_splice();
+    test_splice_late_data();
+    test_splice_backpressure();
+    test_sendfile();
+    test_park_in_iomanager();
+    test_write_partial();
+    test_full_duplex();
+    test_close_wakes_parked();
+    std::cout << "SocketStream_test passed" << std::endl;
+    return 0;
+}
@@ -13,7 +13,7 @@
 #include <pthread.h> // Include the header file for pthread_getthreadid_np function
 
 namespace myCoroutine {
-pid_t GetThreadId() {
+inline pid_t GetThreadId() {
     return syscall(SYS_gettid);
 }
 }